@@ -16,6 +16,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #define DLL_EXPORT __declspec(dllexport)
 
@@ -27,6 +32,25 @@ double process_unweighted(register double val);
 double process_wow(register double val);
 double process_flutter(register double val);
 
+// Metrics function declarations
+void metrics_record_call(int sample_rate, int num_samples,
+        int processed_samples, int windows_processed, int skipped_level,
+        int skipped_crossings, int skipped_hypothesis, double elapsed_seconds);
+void metrics_export();
+
+// Deviation tap function declarations
+int tap_is_enabled();
+void tap_push(double time_s, double unweighted, double weighted);
+void tap_restart();
+
+// Test tone detection function declarations
+void hypothesis_reset(int sample_rate, const double *frequencies, int count);
+void hypothesis_break();
+int hypothesis_process_window(const int *samples, int num_samples,
+        int raw_crossings);
+double hypothesis_frequency(int lane);
+int hypothesis_max_candidates();
+
 // ============================================================================
 // STATE VARIABLES - Zero-crossing interval tracking
 // ============================================================================
@@ -43,6 +67,9 @@ static double interval_remainder_ns = 0;
 /** Time between samples in nanoseconds */
 static double nanoseconds_per_sample = 0;
 
+/** Processed samples before the current window since initialization */
+static long long stream_sample_index = 0;
+
 // ============================================================================
 // CONFIGURATION VARIABLES - Test signal parameters
 // ============================================================================
@@ -53,6 +80,15 @@ static double expected_half_period_ns = 0.5 * 1.0e9 / 3150;
 /** Center frequency of test signal (Hz) */
 static int test_frequency_hz = 3150;
 
+/** Test frequency as configured, 0 while auto-detection is pending (Hz) */
+static double configured_frequency_hz = 3150;
+
+/** Flag indicating flutterMeter_init_auto() has not committed a frequency */
+static int hypothesis_pending = 0;
+
+/** Largest maximum zero-crossing count among the auto-mode candidates */
+static int max_candidate_crossings = 0;
+
 /** Minimum acceptable zero-crossings per 100ms window */
 static int min_zero_crossings = 0;
 
@@ -126,6 +162,91 @@ static double result_quasi_peak = 0;
 /** Measured center frequency (Hz) */
 static double result_frequency_hz = 0;
 
+// ============================================================================
+// INTERNAL FUNCTIONS
+// ============================================================================
+
+/**
+ * @brief Read a monotonic wall clock
+ *
+ * Used to time process_samples() for the metrics. clock() is not suitable:
+ * on POSIX it measures CPU time of the whole process, on Windows wall time.
+ *
+ * @return Time in seconds from an arbitrary starting point
+ */
+static double wall_clock_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+#endif
+}
+
+/**
+ * @brief Compute the acceptable zero-crossing range for a test frequency
+ *
+ * Shared with the candidate trackers in hypothesis.c, so a candidate is
+ * validated against exactly the limits it will be measured with.
+ *
+ * @param test_frequency Expected test tone frequency in Hz
+ * @param[out] min_crossings Minimum zero-crossings per 100ms window
+ * @param[out] max_crossings Maximum zero-crossings per 100ms window
+ */
+void crossing_limits(double test_frequency, int *min_crossings,
+        int *max_crossings)
+{
+    int frequency_hz = test_frequency;
+
+    // Set acceptable zero-crossing range (±5% of expected count)
+    // In 100ms at test_frequency Hz, expect (test_frequency / 5) crossings
+    *min_crossings = frequency_hz / 5 * 0.95;
+    *max_crossings = frequency_hz / 5 * 1.05;
+}
+
+/**
+ * @brief Configure the expected test tone and the zero-crossing limits
+ *
+ * @param test_frequency Expected test tone frequency in Hz
+ */
+static void configure_test_frequency(double test_frequency)
+{
+    configured_frequency_hz = test_frequency;
+    test_frequency_hz = test_frequency;
+    expected_half_period_ns = 0.5 * 1.0e9 / test_frequency;
+    crossing_limits(test_frequency, &min_zero_crossings, &max_zero_crossings);
+}
+
+/**
+ * @brief Upper bound of zero-crossings one process_samples() call evaluates
+ *
+ * Used by the deviation tap to size its ring buffer. While auto-detection
+ * is pending, the fastest candidate is taken.
+ *
+ * @return Maximum crossings per call, 0 if the meter is not initialized
+ */
+int max_crossings_per_call()
+{
+    if (samples_per_100ms == 0)
+    {
+        return 0;
+    }
+
+    int max_crossings = max_zero_crossings;
+    if (hypothesis_pending && (max_candidate_crossings > max_crossings))
+    {
+        max_crossings = max_candidate_crossings;
+    }
+
+    // 100 windows of 100ms per call
+    return 100 * max_crossings;
+}
+
 // ============================================================================
 // PUBLIC API FUNCTIONS
 // ============================================================================
@@ -147,13 +268,8 @@ DLL_EXPORT void flutterMeter_init(int sample_rate, double test_frequency)
     reset_filters();
 
     // Configure test signal parameters
-    test_frequency_hz = test_frequency;
-    expected_half_period_ns = 0.5 * 1.0e9 / test_frequency;
-
-    // Set acceptable zero-crossing range (±5% of expected count)
-    // In 100ms at test_frequency Hz, expect (test_frequency / 5) crossings
-    min_zero_crossings = test_frequency_hz / 5 * 0.95;
-    max_zero_crossings = test_frequency_hz / 5 * 1.05;
+    configure_test_frequency(test_frequency);
+    hypothesis_pending = 0;
 
     // Calculate samples per measurement window
     samples_per_100ms = sample_rate / 10;
@@ -168,6 +284,8 @@ DLL_EXPORT void flutterMeter_init(int sample_rate, double test_frequency)
     interval_remainder_ns = 0;
     previous_sample = 0;
     current_quasi_peak = 0.0;
+    stream_sample_index = 0;
+    tap_restart();
 
     // Clear buffer arrays
     for (int i = 0; i < 10; i++)
@@ -184,6 +302,61 @@ DLL_EXPORT void flutterMeter_init(int sample_rate, double test_frequency)
     peak_index_100ms = 0;
 }
 
+/**
+ * @brief Initialize the flutter meter for an unknown test tone
+ *
+ * Tracks all candidate frequencies in parallel during process_samples()
+ * and commits to the first one whose 100ms windows consistently validate.
+ * Windows are skipped until then; no data is read twice.
+ *
+ * @param sample_rate Sample rate in Hz (e.g., 48000)
+ * @param candidate_frequencies Candidate test tone frequencies in Hz
+ *                              (e.g., 3000 and 3150)
+ * @param num_candidates Number of candidates (1 to 8)
+ * @return 0 on success, -1 if the number of candidates is not supported
+ *         or a candidate is not between 0 Hz and half the sample rate
+ */
+DLL_EXPORT int flutterMeter_init_auto(int sample_rate,
+        const double *candidate_frequencies, int num_candidates)
+{
+    if ((candidate_frequencies == NULL) || (num_candidates < 1)
+            || (num_candidates > hypothesis_max_candidates()))
+    {
+        return -1;
+    }
+
+    // Reject candidates the bandpass trackers cannot represent
+    for (int k = 0; k < num_candidates; k++)
+    {
+        if (!(candidate_frequencies[k] > 0)
+                || (candidate_frequencies[k] >= sample_rate / 2.0))
+        {
+            return -1;
+        }
+    }
+
+    flutterMeter_init(sample_rate, candidate_frequencies[0]);
+    hypothesis_reset(sample_rate, candidate_frequencies, num_candidates);
+
+    // Size for the fastest candidate until one is committed
+    max_candidate_crossings = 0;
+    for (int k = 0; k < num_candidates; k++)
+    {
+        int min_crossings, max_crossings;
+        crossing_limits(candidate_frequencies[k], &min_crossings,
+                &max_crossings);
+        if (max_crossings > max_candidate_crossings)
+        {
+            max_candidate_crossings = max_crossings;
+        }
+    }
+
+    configured_frequency_hz = 0;
+    hypothesis_pending = 1;
+
+    return 0;
+}
+
 /**
  * @brief Process audio samples and compute wow/flutter measurements
  *
@@ -201,9 +374,22 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
     double freq_sum_5sec = 0.0;
     int freq_count_5sec = 0;
 
+    // Metrics for this call, handed over once at the end
+    double start_time = wall_clock_seconds();
+    int windows_processed = 0;
+    int windows_skipped_level = 0;
+    int windows_skipped_crossings = 0;
+    int windows_skipped_hypothesis = 0;
+
+    // Sampled once so the tap can be toggled between calls only
+    int tap_active = tap_is_enabled();
+
     // Verify we have enough samples for 10 seconds of processing
     if (num_samples < samples_per_100ms * 100)
     {
+        metrics_record_call(samples_per_100ms * 10, num_samples,
+                0, 0, 0, 0, 0, wall_clock_seconds() - start_time);
+        metrics_export();
         return -1; // Not enough samples
     }
 
@@ -238,15 +424,42 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
         // Skip if signal is too weak (below threshold)
         if (max_amplitude < 50)
         {
+            windows_skipped_level++;
             samples += samples_per_100ms;
+            stream_sample_index += samples_per_100ms;
+
+            // A dropout breaks the run of windows the trackers vote on
+            if (hypothesis_pending)
+            {
+                hypothesis_break();
+            }
             continue;
         }
 
+        // Let the candidate trackers decide the test frequency first
+        if (hypothesis_pending)
+        {
+            int lane = hypothesis_process_window(samples, samples_per_100ms,
+                    zero_crossing_count);
+            if (lane < 0)
+            {
+                windows_skipped_hypothesis++;
+                samples += samples_per_100ms;
+                stream_sample_index += samples_per_100ms;
+                continue;
+            }
+
+            configure_test_frequency(hypothesis_frequency(lane));
+            hypothesis_pending = 0;
+        }
+
         // Skip if frequency is out of acceptable range
         if ((zero_crossing_count < min_zero_crossings)
                 || (zero_crossing_count > max_zero_crossings))
         {
+            windows_skipped_crossings++;
             samples += samples_per_100ms;
+            stream_sample_index += samples_per_100ms;
             continue;
         }
 
@@ -310,6 +523,7 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
                 // Calculate timing error as percentage deviation
                 double timing_error_percent = (expected_half_period_ns
                         - current_interval_ns) / expected_half_period_ns;
+                double unweighted_error = timing_error_percent;
 
                 // Apply selected weighting filter
                 switch (filter_type)
@@ -336,6 +550,16 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
                     break;
                 }
 
+                // Feed the live deviation tap, timed at the interpolated crossing
+                if (tap_active)
+                {
+                    double crossing_time_ns = (stream_sample_index + i)
+                            * nanoseconds_per_sample - interval_remainder_ns;
+                    tap_push(crossing_time_ns / 1.0e9,
+                            unweighted_error * 100,
+                            timing_error_percent * 100);
+                }
+
                 // Convert to measurement units (empirical calibration)
                 double measurement_value = fabs(timing_error_percent) * 10000 / 85;
 
@@ -368,6 +592,8 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
 
         // Move to next 100ms window
         samples += samples_per_100ms;
+        stream_sample_index += samples_per_100ms;
+        windows_processed++;
 
         // Store results for this 100ms window
         buffer_rms_1sec_sums[rms_1sec_buffer_index] = sum_of_squares;
@@ -425,6 +651,12 @@ DLL_EXPORT int process_samples(const int *samples, int num_samples,
         }
     }
 
+    metrics_record_call(samples_per_100ms * 10, num_samples,
+            samples_per_100ms * 100, windows_processed,
+            windows_skipped_level, windows_skipped_crossings,
+            windows_skipped_hypothesis, wall_clock_seconds() - start_time);
+    metrics_export();
+
     return 0;
 }
 
@@ -441,3 +673,14 @@ DLL_EXPORT void get_results(double *peak, double *rms, double *freq)
     *rms = result_rms_percent;
     *freq = result_frequency_hz;
 }
+
+/**
+ * @brief Retrieve the test tone frequency in use
+ *
+ * @return Test frequency in Hz, or 0 while flutterMeter_init_auto() has not
+ *         yet committed to a candidate
+ */
+DLL_EXPORT double flutterMeter_get_test_frequency(void)
+{
+    return configured_frequency_hz;
+}
@@ -7,6 +7,28 @@
 extern "C" {
 #endif
 
+/**
+ * @brief One entry of the live speed deviation tap.
+ *
+ * Deviations are in percent. Without decimation min and max are equal; with
+ * decimation N they span N consecutive zero-crossings and time_s is the
+ * time of the first of them.
+ *
+ * time_s counts processed audio only: samples beyond the 10 seconds a
+ * process_samples() call analyzes, and rejected calls, do not advance it.
+ * It restarts at 0 on flutterMeter_init(), which also discards a partially
+ * decimated entry; entries already in the ring stay readable, so drain the
+ * ring or call flutterMeter_tap_enable() again when starting a new stream.
+ */
+typedef struct
+{
+    double time_s;          // Seconds of processed audio
+    double unweighted_min;  // Deviation before weighting
+    double unweighted_max;
+    double weighted_min;    // Deviation after the selected weighting filter
+    double weighted_max;
+} FlutterMeterTapSample;
+
 /**
  * @brief Initializes the flutter meter processing module.
  *
@@ -19,6 +41,27 @@ extern "C" {
  */
 DLL_EXPORT void flutterMeter_init(int sample_rate, double test_frequency);
 
+/**
+ * @brief Initializes the flutter meter for an unknown test tone.
+ *
+ * Use instead of flutterMeter_init() when the test tone standard is not
+ * known (e.g. 3000 Hz or 3150 Hz, possibly with a speed offset). A bandpass
+ * filter and zero-crossing tracker per candidate runs in the same pass over
+ * the input. The meter commits to the candidate whose 100ms windows pass
+ * the ±5% crossing-count check for 0.5 seconds in a row; a low-level
+ * dropout restarts the count. Windows before that are skipped.
+ *
+ * @param sample_rate            Input signal sample rate in Hz.
+ * @param candidate_frequencies  Candidate test tone frequencies in Hz.
+ * @param num_candidates         Number of candidates (1 to 8).
+ * @return                       0 on success, -1 if candidate_frequencies
+ *                               is NULL, num_candidates is out of range,
+ *                               or a candidate is not above 0 Hz and below
+ *                               half the sample rate.
+ */
+DLL_EXPORT int flutterMeter_init_auto(int sample_rate,
+        const double* candidate_frequencies, int num_candidates);
+
 /**
  * @brief Processes a block of audio samples using the selected filter type.
  *
@@ -45,6 +88,93 @@ DLL_EXPORT int process_samples(const int* samples, int num_samples, int filter_t
  */
 DLL_EXPORT void get_results(double* peak, double* rms, double* freq);
 
+/**
+ * @brief Returns the test tone frequency the meter is measuring against.
+ *
+ * After flutterMeter_init_auto() this is the committed candidate, or 0
+ * while detection is still pending.
+ *
+ * @return Test frequency in Hz.
+ */
+DLL_EXPORT double flutterMeter_get_test_frequency(void);
+
+/**
+ * @brief Enables or disables the Prometheus metrics file exporter.
+ *
+ * When enabled, the file is rewritten in Prometheus text format after every
+ * call to process_samples(). It is written to "<path>.tmp" first and then
+ * renamed, so it can be scraped by a textfile collector at any time.
+ *
+ * @param path   File to rewrite, or NULL to disable the exporter.
+ * @return       0 on success, -1 if the path is too long.
+ */
+DLL_EXPORT int flutterMeter_set_metrics_file(const char* path);
+
+/**
+ * @brief Formats the analyzer metrics in Prometheus text format.
+ *
+ * Exposes throughput, real-time factor, unprocessed samples, skipped
+ * windows by reason, the current RMS/peak/frequency results and a histogram
+ * of process_samples() call latency.
+ *
+ * May be called from any thread, e.g. a scrape handler, while samples are
+ * being processed. The values are updated once per process_samples() call.
+ *
+ * @param buffer Destination buffer, or NULL to query the required length.
+ * @param size   Size of the buffer in bytes.
+ * @return       Length of the full text; the text was truncated if this
+ *               is greater than or equal to size.
+ */
+DLL_EXPORT int flutterMeter_get_metrics(char* buffer, int size);
+
+/**
+ * @brief Enables or disables the live speed deviation tap.
+ *
+ * While enabled, process_samples() writes the deviation of every
+ * zero-crossing into a lock-free ring buffer that another thread can read
+ * with flutterMeter_tap_read() / flutterMeter_tap_release(). Call it after
+ * flutterMeter_init() or flutterMeter_init_auto(): the ring is allocated
+ * here, sized for two process_samples() calls at the configured test
+ * frequency, and freed when the tap is disabled. Re-enable after
+ * initializing for a higher test frequency. Enabling clears the ring; do
+ * not call it while samples are being processed or read.
+ *
+ * @param decimation  Zero-crossings per entry, folded to min/max
+ *                    (1 = every crossing, 0 = tap disabled).
+ * @return            0 on success, -1 if the meter is not initialized or
+ *                    the ring cannot be allocated.
+ */
+DLL_EXPORT int flutterMeter_tap_enable(int decimation);
+
+/**
+ * @brief Gets the tap entries waiting for the reader, without copying.
+ *
+ * Returns the contiguous run of entries starting at the read position.
+ * The entries stay valid until they are released.
+ *
+ * @param entries  Pointer that receives the address of the first entry.
+ * @return         Number of entries available at *entries.
+ */
+DLL_EXPORT int flutterMeter_tap_read(const FlutterMeterTapSample** entries);
+
+/**
+ * @brief Releases tap entries the reader has finished with.
+ *
+ * @param count  Number of entries to release, at most the value returned
+ *               by the last flutterMeter_tap_read(). Larger values are
+ *               clamped, negative values are ignored.
+ */
+DLL_EXPORT void flutterMeter_tap_release(int count);
+
+/**
+ * @brief Returns the number of tap entries dropped because the ring was full.
+ *
+ * The ring holds two process_samples() calls' worth of entries, so entries
+ * are only dropped when the reader has not drained the previous calls
+ * before the next one fills the ring.
+ */
+DLL_EXPORT unsigned int flutterMeter_tap_dropped(void);
+
 #ifdef __cplusplus
 }
 #endif
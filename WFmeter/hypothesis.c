@@ -0,0 +1,247 @@
+/**
+ * @file hypothesis.c
+ * @brief Test tone detection by parallel candidate trackers
+ *
+ * Used by flutterMeter_init_auto() when the test tone frequency is not
+ * known in advance (e.g. 3000 Hz vs 3150 Hz, possibly with a speed offset).
+ * Every candidate frequency gets its own bandpass filter and zero-crossing
+ * counter. All candidates run side by side on the same samples, so the
+ * input is read only once per 100ms window regardless of the number of
+ * candidates.
+ *
+ * Candidate state is kept as structure-of-arrays and every inner loop runs
+ * over a fixed number of lanes, which lets the compiler map the candidates
+ * onto SIMD lanes. Unused lanes have zero coefficients and are ignored.
+ *
+ * A candidate validates a window when both its filtered zero-crossing count
+ * and the raw zero-crossing count of the window are within its ±5% limits.
+ * The raw count is the one process_samples() checks once the candidate is
+ * committed, so a committed candidate is never rejected by the meter for a
+ * window it validated. If several validate, the one with the most energy in
+ * its band (the closest match) wins. The candidate is committed once it has
+ * won HYPOTHESIS_CONFIRM_WINDOWS consecutive windows.
+ */
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Zero-crossing limit declaration (flutter_meter.c)
+void crossing_limits(double test_frequency, int *min_crossings,
+        int *max_crossings);
+
+/** Number of candidate lanes, also the maximum number of candidates */
+#define HYPOTHESIS_LANES 8
+
+/** Consecutive winning windows needed to commit to a candidate */
+#define HYPOTHESIS_CONFIRM_WINDOWS 5
+
+/** Quality factor of the candidate bandpass filters */
+#define HYPOTHESIS_Q 10.0
+
+// ============================================================================
+// CANDIDATE LANES - Bandpass filter and crossing tracker per candidate
+// ============================================================================
+
+/** Candidate test frequencies (Hz) */
+static double lane_frequency[HYPOTHESIS_LANES];
+
+/** Bandpass feed-forward gain (b0 = -b2, b1 = 0) */
+static double lane_b0[HYPOTHESIS_LANES];
+
+/** Bandpass feedback coefficients */
+static double lane_a1[HYPOTHESIS_LANES];
+static double lane_a2[HYPOTHESIS_LANES];
+
+/** Bandpass filter state (transposed direct form II) */
+static double lane_z1[HYPOTHESIS_LANES];
+static double lane_z2[HYPOTHESIS_LANES];
+
+/** Previous filter output for zero-crossing detection */
+static double lane_previous[HYPOTHESIS_LANES];
+
+/** Acceptable zero-crossing range per 100ms window */
+static double lane_min_crossings[HYPOTHESIS_LANES];
+static double lane_max_crossings[HYPOTHESIS_LANES];
+
+/** Number of lanes in use */
+static int lane_count = 0;
+
+// ============================================================================
+// DECISION STATE
+// ============================================================================
+
+/** Lane that won the most recent windows, -1 if none */
+static int leading_lane = -1;
+
+/** Number of consecutive windows won by leading_lane */
+static int leading_windows = 0;
+
+// ============================================================================
+// INTERNAL FUNCTIONS - Called from flutter_meter.c
+// ============================================================================
+
+/**
+ * @brief Set up one tracker lane per candidate frequency
+ *
+ * @param sample_rate Sample rate in Hz
+ * @param frequencies Candidate test frequencies in Hz
+ * @param count Number of candidates (1..HYPOTHESIS_LANES)
+ */
+void hypothesis_reset(int sample_rate, const double *frequencies, int count)
+{
+    lane_count = count;
+    leading_lane = -1;
+    leading_windows = 0;
+
+    for (int k = 0; k < HYPOTHESIS_LANES; k++)
+    {
+        lane_frequency[k] = 0.0;
+        lane_b0[k] = 0.0;
+        lane_a1[k] = 0.0;
+        lane_a2[k] = 0.0;
+        lane_z1[k] = 0.0;
+        lane_z2[k] = 0.0;
+        lane_previous[k] = 0.0;
+        lane_min_crossings[k] = 0.0;
+        lane_max_crossings[k] = 0.0;
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        // Constant 0 dB peak gain bandpass (RBJ audio EQ cookbook)
+        double w0 = 2.0 * M_PI * frequencies[k] / sample_rate;
+        double alpha = sin(w0) / (2.0 * HYPOTHESIS_Q);
+        double a0 = 1.0 + alpha;
+
+        lane_frequency[k] = frequencies[k];
+        lane_b0[k] = alpha / a0;
+        lane_a1[k] = -2.0 * cos(w0) / a0;
+        lane_a2[k] = (1.0 - alpha) / a0;
+
+        // Same ±5% range the candidate is measured with once committed
+        int min_crossings, max_crossings;
+        crossing_limits(frequencies[k], &min_crossings, &max_crossings);
+        lane_min_crossings[k] = min_crossings;
+        lane_max_crossings[k] = max_crossings;
+    }
+}
+
+/**
+ * @brief Restart tracking after a gap in the signal
+ *
+ * Called for windows skipped before they reach the trackers (e.g. signal
+ * dropouts). Clears the filter state, which no longer matches contiguous
+ * audio, and the run of consecutive winning windows.
+ */
+void hypothesis_break()
+{
+    leading_lane = -1;
+    leading_windows = 0;
+
+    for (int k = 0; k < HYPOTHESIS_LANES; k++)
+    {
+        lane_z1[k] = 0.0;
+        lane_z2[k] = 0.0;
+        lane_previous[k] = 0.0;
+    }
+}
+
+/**
+ * @brief Run all candidate trackers over one 100ms window
+ *
+ * @param samples Pointer to the window's samples
+ * @param num_samples Number of samples in the window
+ * @param raw_crossings Zero-crossing count of the unfiltered window
+ * @return Index of the committed candidate, or -1 if still undecided
+ */
+int hypothesis_process_window(const int *samples, int num_samples,
+        int raw_crossings)
+{
+    double crossings[HYPOTHESIS_LANES] = { 0 };
+    double energy[HYPOTHESIS_LANES] = { 0 };
+
+    // Single pass over the window, all candidates per sample
+    for (int i = 0; i < num_samples; i++)
+    {
+        double x = (short) samples[i];
+
+        for (int k = 0; k < HYPOTHESIS_LANES; k++)
+        {
+            double y = lane_b0[k] * x + lane_z1[k];
+            lane_z1[k] = lane_z2[k] - lane_a1[k] * y;
+            lane_z2[k] = -lane_b0[k] * x - lane_a2[k] * y;
+
+            crossings[k] += ((y < 0) != (lane_previous[k] < 0)) ? 1.0 : 0.0;
+            energy[k] += y * y;
+            lane_previous[k] = y;
+        }
+    }
+
+    // Pick the strongest candidate whose crossing counts both validate
+    int best_lane = -1;
+    for (int k = 0; k < lane_count; k++)
+    {
+        if ((crossings[k] < lane_min_crossings[k])
+                || (crossings[k] > lane_max_crossings[k]))
+        {
+            continue;
+        }
+
+        if ((raw_crossings < lane_min_crossings[k])
+                || (raw_crossings > lane_max_crossings[k]))
+        {
+            continue;
+        }
+
+        if ((best_lane < 0) || (energy[k] > energy[best_lane]))
+        {
+            best_lane = k;
+        }
+    }
+
+    if (best_lane < 0)
+    {
+        leading_lane = -1;
+        leading_windows = 0;
+        return -1;
+    }
+
+    if (best_lane == leading_lane)
+    {
+        leading_windows++;
+    }
+    else
+    {
+        leading_lane = best_lane;
+        leading_windows = 1;
+    }
+
+    if (leading_windows >= HYPOTHESIS_CONFIRM_WINDOWS)
+    {
+        return leading_lane;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Get the frequency of a candidate lane
+ *
+ * @param lane Lane index returned by hypothesis_process_window()
+ * @return Candidate test frequency in Hz
+ */
+double hypothesis_frequency(int lane)
+{
+    return lane_frequency[lane];
+}
+
+/**
+ * @brief Get the maximum number of candidates
+ */
+int hypothesis_max_candidates()
+{
+    return HYPOTHESIS_LANES;
+}
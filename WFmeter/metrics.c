@@ -0,0 +1,450 @@
+/**
+ * @file metrics.c
+ * @brief Prometheus text-format metrics for long-running analyzers
+ *
+ * The measurement loop only fills a few local counters while it runs and
+ * hands them over once per process_samples() call, so nothing here is
+ * touched per sample or per zero-crossing. Counters are cumulative for the
+ * lifetime of the library; gauges describe the most recent call.
+ *
+ * The text can be pulled on demand with flutterMeter_get_metrics(), or the
+ * library can rewrite a file after every call (suitable for the node
+ * exporter textfile collector). The file is written to "<path>.tmp" first
+ * and then renamed, so a scraper never sees a half-written file.
+ *
+ * Every value is an atomic that only process_samples() writes, once per
+ * call, with relaxed stores. flutterMeter_get_metrics() can therefore be
+ * called from a scraper thread at any time without locking the analyzer.
+ * Values written by the same call may be seen partly old, partly new.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "flutter_meter.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Deviation tap function declarations
+int tap_depth();
+
+/** Number of finite buckets in the call latency histogram */
+#define LATENCY_BUCKETS 10
+
+/** Maximum length of the metrics file path */
+#define METRICS_PATH_MAX 1024
+
+// ============================================================================
+// COUNTERS - Cumulative since library load
+// ============================================================================
+
+/** Number of process_samples() calls */
+static atomic_ullong calls_total = 0;
+
+/** Calls rejected because less than 10 seconds of samples were supplied */
+static atomic_ullong calls_rejected_total = 0;
+
+/** Samples consumed by the measurement loop */
+static atomic_ullong samples_total = 0;
+
+/** 100ms windows that contributed to the measurement */
+static atomic_ullong windows_processed_total = 0;
+
+/** 100ms windows skipped because the signal was too weak */
+static atomic_ullong windows_skipped_level_total = 0;
+
+/** 100ms windows skipped because the zero-crossing count was out of range */
+static atomic_ullong windows_skipped_crossings_total = 0;
+
+/** 100ms windows skipped while the test frequency was being detected */
+static atomic_ullong windows_skipped_hypothesis_total = 0;
+
+/** Processing time spent inside process_samples() (seconds) */
+static _Atomic double processing_seconds_total = 0.0;
+
+/** Audio time consumed by process_samples() (seconds) */
+static _Atomic double audio_seconds_total = 0.0;
+
+// ============================================================================
+// GAUGES - Most recent call
+// ============================================================================
+
+/** Throughput of the last call (samples per second of processing time) */
+static _Atomic double last_samples_per_second = 0.0;
+
+/** Audio seconds analyzed per second of processing time in the last call */
+static _Atomic double last_realtime_factor = 0.0;
+
+/** Samples beyond the 10 seconds that the last call ignored */
+static atomic_int last_unprocessed_samples = 0;
+
+/** Results of the last call, as returned by get_results() */
+static _Atomic double result_rms = 0.0;
+static _Atomic double result_peak = 0.0;
+static _Atomic double result_frequency = 0.0;
+
+// ============================================================================
+// LATENCY HISTOGRAM - process_samples() call duration
+// ============================================================================
+
+/** Upper bounds of the histogram buckets (seconds) */
+static const double latency_bounds[LATENCY_BUCKETS] =
+{
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0
+};
+
+/** Non-cumulative bucket counts, the last slot is the +Inf bucket */
+static atomic_ullong latency_counts[LATENCY_BUCKETS + 1];
+
+/** Sum of all observed call durations (seconds) */
+static _Atomic double latency_sum = 0.0;
+
+// ============================================================================
+// EXPORTER STATE
+// ============================================================================
+
+/** Destination file, empty when the file exporter is disabled */
+static char metrics_path[METRICS_PATH_MAX] = "";
+
+// ============================================================================
+// ATOMIC HELPERS - Single writer, so no read-modify-write is needed
+// ============================================================================
+
+/** Add to a counter written only by process_samples() */
+static void counter_add(atomic_ullong *counter, unsigned long long value)
+{
+    atomic_store_explicit(counter,
+            atomic_load_explicit(counter, memory_order_relaxed) + value,
+            memory_order_relaxed);
+}
+
+/** Add to a floating point total written only by process_samples() */
+static void total_add(_Atomic double *total, double value)
+{
+    atomic_store_explicit(total,
+            atomic_load_explicit(total, memory_order_relaxed) + value,
+            memory_order_relaxed);
+}
+
+/** Set a floating point gauge */
+static void gauge_set(_Atomic double *gauge, double value)
+{
+    atomic_store_explicit(gauge, value, memory_order_relaxed);
+}
+
+/** Read a counter from any thread */
+static unsigned long long counter_get(atomic_ullong *counter)
+{
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/** Read a floating point total or gauge from any thread */
+static double value_get(_Atomic double *value)
+{
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+// ============================================================================
+// INTERNAL FUNCTIONS - Called from flutter_meter.c
+// ============================================================================
+
+/**
+ * @brief Record the counters gathered during one process_samples() call
+ *
+ * Also snapshots the current results, so that scrapers never have to touch
+ * the meter state.
+ *
+ * @param sample_rate Sample rate the meter was initialized with (Hz)
+ * @param num_samples Number of samples handed to process_samples()
+ * @param processed_samples Number of samples actually consumed (0 if rejected)
+ * @param windows_processed Windows that contributed to the measurement
+ * @param skipped_level Windows skipped because the signal was too weak
+ * @param skipped_crossings Windows skipped because of the zero-crossing count
+ * @param skipped_hypothesis Windows skipped while detecting the test frequency
+ * @param elapsed_seconds Processing time of the call (seconds)
+ */
+void metrics_record_call(int sample_rate, int num_samples,
+        int processed_samples, int windows_processed, int skipped_level,
+        int skipped_crossings, int skipped_hypothesis, double elapsed_seconds)
+{
+    counter_add(&calls_total, 1);
+
+    if (processed_samples == 0)
+    {
+        counter_add(&calls_rejected_total, 1);
+    }
+    atomic_store_explicit(&last_unprocessed_samples,
+            num_samples - processed_samples, memory_order_relaxed);
+
+    counter_add(&samples_total, processed_samples);
+    counter_add(&windows_processed_total, windows_processed);
+    counter_add(&windows_skipped_level_total, skipped_level);
+    counter_add(&windows_skipped_crossings_total, skipped_crossings);
+    counter_add(&windows_skipped_hypothesis_total, skipped_hypothesis);
+    total_add(&processing_seconds_total, elapsed_seconds);
+
+    double audio_seconds = 0.0;
+    if (sample_rate > 0)
+    {
+        audio_seconds = (double) processed_samples / sample_rate;
+    }
+    total_add(&audio_seconds_total, audio_seconds);
+
+    // Rejected calls say nothing about throughput, and the clock resolution
+    // may round very short calls down to zero
+    if ((processed_samples > 0) && (elapsed_seconds > 0.0))
+    {
+        gauge_set(&last_samples_per_second,
+                processed_samples / elapsed_seconds);
+        gauge_set(&last_realtime_factor, audio_seconds / elapsed_seconds);
+    }
+
+    double peak, rms, freq;
+    get_results(&peak, &rms, &freq);
+    gauge_set(&result_peak, peak);
+    gauge_set(&result_rms, rms);
+    gauge_set(&result_frequency, freq);
+
+    // Histogram buckets are stored non-cumulative and summed on export
+    int bucket = 0;
+    while ((bucket < LATENCY_BUCKETS)
+            && (elapsed_seconds > latency_bounds[bucket]))
+    {
+        bucket++;
+    }
+    counter_add(&latency_counts[bucket], 1);
+    total_add(&latency_sum, elapsed_seconds);
+}
+
+/**
+ * @brief Append formatted text to a buffer, tracking the required length
+ *
+ * Behaves like snprintf() into buffer + *length, but keeps counting the
+ * required length once the buffer is full.
+ */
+static void append(char *buffer, int size, int *length, const char *format,
+        ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    int room = size - *length;
+    int written;
+    if ((buffer != NULL) && (room > 0))
+    {
+        written = vsnprintf(buffer + *length, room, format, args);
+    }
+    else
+    {
+        written = vsnprintf(NULL, 0, format, args);
+    }
+
+    va_end(args);
+
+    if (written > 0)
+    {
+        *length += written;
+    }
+}
+
+/**
+ * @brief Write all metrics in Prometheus text exposition format
+ *
+ * @return Length of the full text, excluding the terminating zero
+ */
+static int format_metrics(char *buffer, int size)
+{
+    int length = 0;
+
+    append(buffer, size, &length,
+            "# HELP wf_calls_total Number of process_samples calls.\n"
+            "# TYPE wf_calls_total counter\n"
+            "wf_calls_total %llu\n",
+            counter_get(&calls_total));
+    append(buffer, size, &length,
+            "# HELP wf_calls_rejected_total Calls rejected for holding less than 10 seconds of samples.\n"
+            "# TYPE wf_calls_rejected_total counter\n"
+            "wf_calls_rejected_total %llu\n",
+            counter_get(&calls_rejected_total));
+    append(buffer, size, &length,
+            "# HELP wf_samples_processed_total Samples consumed by the analyzer.\n"
+            "# TYPE wf_samples_processed_total counter\n"
+            "wf_samples_processed_total %llu\n",
+            counter_get(&samples_total));
+    append(buffer, size, &length,
+            "# HELP wf_audio_seconds_total Audio time consumed by the analyzer.\n"
+            "# TYPE wf_audio_seconds_total counter\n"
+            "wf_audio_seconds_total %.6f\n",
+            value_get(&audio_seconds_total));
+    append(buffer, size, &length,
+            "# HELP wf_processing_seconds_total Processing time spent in process_samples.\n"
+            "# TYPE wf_processing_seconds_total counter\n"
+            "wf_processing_seconds_total %.6f\n",
+            value_get(&processing_seconds_total));
+    append(buffer, size, &length,
+            "# HELP wf_windows_processed_total 100ms windows used for measurement.\n"
+            "# TYPE wf_windows_processed_total counter\n"
+            "wf_windows_processed_total %llu\n",
+            counter_get(&windows_processed_total));
+    append(buffer, size, &length,
+            "# HELP wf_windows_skipped_total 100ms windows skipped, by reason.\n"
+            "# TYPE wf_windows_skipped_total counter\n"
+            "wf_windows_skipped_total{reason=\"low_level\"} %llu\n"
+            "wf_windows_skipped_total{reason=\"crossing_count\"} %llu\n"
+            "wf_windows_skipped_total{reason=\"frequency_detection\"} %llu\n",
+            counter_get(&windows_skipped_level_total),
+            counter_get(&windows_skipped_crossings_total),
+            counter_get(&windows_skipped_hypothesis_total));
+
+    append(buffer, size, &length,
+            "# HELP wf_samples_per_second Throughput of the last call.\n"
+            "# TYPE wf_samples_per_second gauge\n"
+            "wf_samples_per_second %.1f\n",
+            value_get(&last_samples_per_second));
+    append(buffer, size, &length,
+            "# HELP wf_realtime_factor Audio seconds analyzed per processing second in the last call.\n"
+            "# TYPE wf_realtime_factor gauge\n"
+            "wf_realtime_factor %.3f\n",
+            value_get(&last_realtime_factor));
+    append(buffer, size, &length,
+            "# HELP wf_unprocessed_samples Samples beyond 10 seconds ignored by the last call.\n"
+            "# TYPE wf_unprocessed_samples gauge\n"
+            "wf_unprocessed_samples %d\n",
+            atomic_load_explicit(&last_unprocessed_samples,
+                    memory_order_relaxed));
+    append(buffer, size, &length,
+            "# HELP wf_queue_depth Entries waiting for a reader, by queue.\n"
+            "# TYPE wf_queue_depth gauge\n"
+            "wf_queue_depth{queue=\"tap\"} %d\n", tap_depth());
+    append(buffer, size, &length,
+            "# HELP wf_tap_dropped_total Deviation tap entries dropped because the ring was full.\n"
+            "# TYPE wf_tap_dropped_total counter\n"
+            "wf_tap_dropped_total %u\n", flutterMeter_tap_dropped());
+
+    append(buffer, size, &length,
+            "# HELP wf_rms_percent Current RMS wow and flutter.\n"
+            "# TYPE wf_rms_percent gauge\n"
+            "wf_rms_percent %.6f\n", value_get(&result_rms));
+    append(buffer, size, &length,
+            "# HELP wf_quasi_peak Current quasi-peak wow and flutter.\n"
+            "# TYPE wf_quasi_peak gauge\n"
+            "wf_quasi_peak %.6f\n", value_get(&result_peak));
+    append(buffer, size, &length,
+            "# HELP wf_frequency_hz Current measured test tone frequency.\n"
+            "# TYPE wf_frequency_hz gauge\n"
+            "wf_frequency_hz %.4f\n",
+            value_get(&result_frequency));
+
+    append(buffer, size, &length,
+            "# HELP wf_call_latency_seconds Duration of process_samples calls.\n"
+            "# TYPE wf_call_latency_seconds histogram\n");
+    unsigned long long cumulative = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        cumulative += counter_get(&latency_counts[i]);
+        append(buffer, size, &length,
+                "wf_call_latency_seconds_bucket{le=\"%g\"} %llu\n",
+                latency_bounds[i], cumulative);
+    }
+    cumulative += counter_get(&latency_counts[LATENCY_BUCKETS]);
+    append(buffer, size, &length,
+            "wf_call_latency_seconds_bucket{le=\"+Inf\"} %llu\n"
+            "wf_call_latency_seconds_sum %.6f\n"
+            "wf_call_latency_seconds_count %llu\n",
+            cumulative, value_get(&latency_sum), cumulative);
+
+    return length;
+}
+
+/**
+ * @brief Rewrite the metrics file if the file exporter is enabled
+ *
+ * Called at the end of every process_samples() call.
+ */
+void metrics_export()
+{
+    if (metrics_path[0] == '\0')
+    {
+        return;
+    }
+
+    char tmp_path[METRICS_PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", metrics_path);
+
+    int length = format_metrics(NULL, 0);
+    char *text = malloc(length + 1);
+    if (!text)
+    {
+        return;
+    }
+    format_metrics(text, length + 1);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp)
+    {
+        size_t written = fwrite(text, 1, length, fp);
+        if ((fclose(fp) == 0) && (written == (size_t) length))
+        {
+            // rename() does not replace an existing file on Windows
+#ifdef _WIN32
+            MoveFileExA(tmp_path, metrics_path, MOVEFILE_REPLACE_EXISTING);
+#else
+            rename(tmp_path, metrics_path);
+#endif
+        }
+        else
+        {
+            remove(tmp_path);
+        }
+    }
+
+    free(text);
+}
+
+// ============================================================================
+// PUBLIC API FUNCTIONS
+// ============================================================================
+
+/**
+ * @brief Enable or disable the metrics file exporter
+ *
+ * @param path File to rewrite after every process_samples() call,
+ *             or NULL to disable the exporter
+ * @return 0 on success, -1 if the path is too long
+ */
+DLL_EXPORT int flutterMeter_set_metrics_file(const char *path)
+{
+    if (path == NULL)
+    {
+        metrics_path[0] = '\0';
+        return 0;
+    }
+
+    if (strlen(path) >= METRICS_PATH_MAX)
+    {
+        return -1;
+    }
+
+    strcpy(metrics_path, path);
+    return 0;
+}
+
+/**
+ * @brief Format the current metrics in Prometheus text format
+ *
+ * @param[out] buffer Destination buffer (may be NULL to query the length)
+ * @param size Size of the buffer in bytes
+ * @return Length of the full text; if it is >= size the text was truncated
+ */
+DLL_EXPORT int flutterMeter_get_metrics(char *buffer, int size)
+{
+    if ((buffer != NULL) && (size > 0))
+    {
+        buffer[0] = '\0';
+    }
+    return format_metrics(buffer, size);
+}
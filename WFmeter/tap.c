@@ -0,0 +1,284 @@
+/**
+ * @file tap.c
+ * @brief Live per-crossing speed deviation tap for oscilloscope displays
+ *
+ * When enabled, every zero-crossing evaluated by process_samples() pushes
+ * its timestamp and its unweighted and weighted speed deviation into a
+ * single-producer/single-consumer ring buffer. A display thread reads the
+ * entries in place and releases them when done; no locks are taken on
+ * either side.
+ *
+ * With a decimation factor N > 1, each entry covers N consecutive
+ * crossings and carries the minimum and maximum of both deviations, which
+ * is all a min/max trace needs to stay faithful while cutting the data
+ * rate by N.
+ *
+ * process_samples() produces a whole 10-second block of crossings at once,
+ * about 63,000 at 3150 Hz. The ring is allocated when the tap is enabled
+ * and sized for two calls' worth of entries at the configured test
+ * frequency and decimation. Entries are dropped (the reader's data is never
+ * overwritten) and counted only when the reader has not drained the
+ * previous calls by the time the next call fills the ring.
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "flutter_meter.h"
+
+// Meter configuration declaration (flutter_meter.c)
+int max_crossings_per_call();
+
+// ============================================================================
+// RING BUFFER - Shared between process_samples() and the reader
+// ============================================================================
+
+/** Ring buffer storage, read in place by the reader, NULL when disabled */
+static FlutterMeterTapSample *tap_ring = NULL;
+
+/** Ring buffer capacity in entries, a power of two */
+static unsigned int tap_capacity = 0;
+
+/** Free-running write position, advanced only by the producer */
+static atomic_uint tap_write_index = 0;
+
+/** Free-running read position, advanced only by the reader */
+static atomic_uint tap_read_index = 0;
+
+/** Number of entries dropped because the ring was full */
+static atomic_uint tap_dropped_count = 0;
+
+// ============================================================================
+// DECIMATION STATE - Producer side only
+// ============================================================================
+
+/** Crossings per ring entry, 0 when the tap is disabled */
+static int tap_decimation = 0;
+
+/** Crossings accumulated into the pending entry */
+static int tap_pending_count = 0;
+
+/** Entry being accumulated while decimating */
+static FlutterMeterTapSample tap_pending;
+
+// ============================================================================
+// INTERNAL FUNCTIONS - Called from flutter_meter.c
+// ============================================================================
+
+/**
+ * @brief Check whether the tap is enabled
+ *
+ * @return Non-zero if process_samples() should call tap_push()
+ */
+int tap_is_enabled()
+{
+    return tap_decimation > 0;
+}
+
+/**
+ * @brief Feed one zero-crossing to the tap
+ *
+ * @param time_s Seconds of processed audio up to the crossing
+ * @param unweighted Speed deviation before weighting (percent)
+ * @param weighted Speed deviation after the selected weighting filter (percent)
+ */
+void tap_push(double time_s, double unweighted, double weighted)
+{
+    if (tap_pending_count == 0)
+    {
+        tap_pending.time_s = time_s;
+        tap_pending.unweighted_min = unweighted;
+        tap_pending.unweighted_max = unweighted;
+        tap_pending.weighted_min = weighted;
+        tap_pending.weighted_max = weighted;
+    }
+    else
+    {
+        if (unweighted < tap_pending.unweighted_min)
+            tap_pending.unweighted_min = unweighted;
+        if (unweighted > tap_pending.unweighted_max)
+            tap_pending.unweighted_max = unweighted;
+        if (weighted < tap_pending.weighted_min)
+            tap_pending.weighted_min = weighted;
+        if (weighted > tap_pending.weighted_max)
+            tap_pending.weighted_max = weighted;
+    }
+
+    if (++tap_pending_count < tap_decimation)
+    {
+        return;
+    }
+    tap_pending_count = 0;
+
+    // Only the producer writes tap_write_index, so a relaxed load suffices
+    unsigned int write_index = atomic_load_explicit(&tap_write_index,
+            memory_order_relaxed);
+    unsigned int read_index = atomic_load_explicit(&tap_read_index,
+            memory_order_acquire);
+
+    if (write_index - read_index >= tap_capacity)
+    {
+        atomic_fetch_add_explicit(&tap_dropped_count, 1,
+                memory_order_relaxed);
+        return;
+    }
+
+    tap_ring[write_index & (tap_capacity - 1)] = tap_pending;
+
+    // Publish the entry only after it has been written
+    atomic_store_explicit(&tap_write_index, write_index + 1,
+            memory_order_release);
+}
+
+/**
+ * @brief Start a new stream after flutterMeter_init()
+ *
+ * Discards a partially decimated entry of the previous stream. Entries
+ * already in the ring are left for the reader.
+ */
+void tap_restart()
+{
+    tap_pending_count = 0;
+}
+
+/**
+ * @brief Number of entries currently waiting for the reader
+ */
+int tap_depth()
+{
+    unsigned int write_index = atomic_load_explicit(&tap_write_index,
+            memory_order_acquire);
+    unsigned int read_index = atomic_load_explicit(&tap_read_index,
+            memory_order_acquire);
+    return (int) (write_index - read_index);
+}
+
+// ============================================================================
+// PUBLIC API FUNCTIONS
+// ============================================================================
+
+/**
+ * @brief Enable or disable the deviation tap
+ *
+ * Allocates a ring buffer holding two process_samples() calls' worth of
+ * entries for the test frequency the meter is initialized with, or frees
+ * it when disabling. Clears the drop counter. Must not be called while
+ * process_samples() is running or a reader holds entries.
+ *
+ * @param decimation Crossings per ring entry (1 = every crossing),
+ *                   0 to disable the tap
+ * @return 0 on success, -1 if the meter is not initialized or the ring
+ *         cannot be allocated (the tap is then disabled)
+ */
+DLL_EXPORT int flutterMeter_tap_enable(int decimation)
+{
+    free(tap_ring);
+    tap_ring = NULL;
+    tap_capacity = 0;
+    tap_decimation = 0;
+    tap_pending_count = 0;
+
+    atomic_store(&tap_write_index, 0);
+    atomic_store(&tap_read_index, 0);
+    atomic_store(&tap_dropped_count, 0);
+
+    if (decimation <= 0)
+    {
+        return 0;
+    }
+
+    int max_crossings = max_crossings_per_call();
+    if (max_crossings <= 0)
+    {
+        return -1;
+    }
+
+    // Two calls' worth, rounded up to a power of two for index masking
+    unsigned int entries = 2 * (max_crossings / decimation + 1);
+    unsigned int capacity = 1;
+    while (capacity < entries)
+    {
+        capacity <<= 1;
+    }
+
+    tap_ring = malloc(capacity * sizeof(FlutterMeterTapSample));
+    if (!tap_ring)
+    {
+        return -1;
+    }
+
+    tap_capacity = capacity;
+    tap_decimation = decimation;
+    return 0;
+}
+
+/**
+ * @brief Get the entries available to the reader without copying them
+ *
+ * Only the contiguous part of the ring is returned; after releasing it
+ * with flutterMeter_tap_release(), call again to get the wrapped part.
+ *
+ * @param[out] entries Receives a pointer to the first available entry
+ * @return Number of entries available at *entries
+ */
+DLL_EXPORT int flutterMeter_tap_read(const FlutterMeterTapSample **entries)
+{
+    unsigned int read_index = atomic_load_explicit(&tap_read_index,
+            memory_order_relaxed);
+    unsigned int write_index = atomic_load_explicit(&tap_write_index,
+            memory_order_acquire);
+
+    if (!tap_ring)
+    {
+        *entries = NULL;
+        return 0;
+    }
+
+    unsigned int offset = read_index & (tap_capacity - 1);
+    unsigned int available = write_index - read_index;
+
+    if (available > tap_capacity - offset)
+    {
+        available = tap_capacity - offset;
+    }
+
+    *entries = &tap_ring[offset];
+    return (int) available;
+}
+
+/**
+ * @brief Return entries obtained from flutterMeter_tap_read() to the ring
+ *
+ * @param count Number of entries the reader has finished with, clamped
+ *              to the number of entries available
+ */
+DLL_EXPORT void flutterMeter_tap_release(int count)
+{
+    unsigned int read_index = atomic_load_explicit(&tap_read_index,
+            memory_order_relaxed);
+    unsigned int write_index = atomic_load_explicit(&tap_write_index,
+            memory_order_acquire);
+
+    // Never move the read position past the write position
+    if (count <= 0)
+    {
+        return;
+    }
+    if ((unsigned int) count > write_index - read_index)
+    {
+        count = (int) (write_index - read_index);
+    }
+
+    // Entries must be fully read before the producer may overwrite them
+    atomic_store_explicit(&tap_read_index, read_index + count,
+            memory_order_release);
+}
+
+/**
+ * @brief Number of entries dropped because the ring was full
+ *
+ * @return Drop count since the tap was last enabled
+ */
+DLL_EXPORT unsigned int flutterMeter_tap_dropped(void)
+{
+    return atomic_load_explicit(&tap_dropped_count, memory_order_relaxed);
+}